@@ -0,0 +1,295 @@
+#include <compex.h>
+#include <stdint.h>
+#include <string>
+
+// Metadata for these is in json_bench.compex.
+struct COMPEX_TAG("json") Fill {
+  int64_t id;
+  uint32_t qty;
+  double price;
+  bool active;
+  std::string symbol;
+  std::string venue;
+};
+
+struct COMPEX_TAG("json") Order {
+  int64_t id;
+  uint32_t qty;
+  double price;
+  bool active;
+  std::string symbol;
+  std::string note;
+  Fill last_fill;
+  int32_t flags;
+};
+
+#include "json_bench.h"
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <iomanip>
+
+// Generic path
+// ------------
+// A document model of the kind a reflection-free library would use: each
+// structure is converted to a map of named values which is then printed,
+// and parsing builds the map before fields are looked up by name.
+
+struct Value {
+  enum Kind { NUM, BOOL, STR, OBJ } kind = NUM;
+  std::string s;                      // number text or string contents
+  bool b = false;
+  std::map<std::string, Value> obj;
+};
+
+static Value num(double v) {
+  std::ostringstream o;
+  o << std::setprecision(17) << v;
+  Value r; r.s = o.str(); return r;
+}
+static Value num(int64_t v) { Value r; r.s = std::to_string(v); return r; }
+static Value boolean(bool v) { Value r; r.kind = Value::BOOL; r.b = v; return r; }
+static Value str(const std::string &v) { Value r; r.kind = Value::STR; r.s = v; return r; }
+
+static Value to_value(const Fill &f) {
+  Value r; r.kind = Value::OBJ;
+  r.obj["id"] = num((int64_t)f.id);
+  r.obj["qty"] = num((int64_t)f.qty);
+  r.obj["price"] = num(f.price);
+  r.obj["active"] = boolean(f.active);
+  r.obj["symbol"] = str(f.symbol);
+  r.obj["venue"] = str(f.venue);
+  return r;
+}
+
+static Value to_value(const Order &o) {
+  Value r; r.kind = Value::OBJ;
+  r.obj["id"] = num((int64_t)o.id);
+  r.obj["qty"] = num((int64_t)o.qty);
+  r.obj["price"] = num(o.price);
+  r.obj["active"] = boolean(o.active);
+  r.obj["symbol"] = str(o.symbol);
+  r.obj["note"] = str(o.note);
+  r.obj["last_fill"] = to_value(o.last_fill);
+  r.obj["flags"] = num((int64_t)o.flags);
+  return r;
+}
+
+static void print(std::ostream &out, const Value &v) {
+  switch (v.kind) {
+    case Value::NUM:  out << v.s; break;
+    case Value::BOOL: out << (v.b ? "true" : "false"); break;
+    case Value::STR:
+      out << '"';
+      for (char c : v.s) {
+        if (c == '"' || c == '\\')
+          out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+          out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+        else
+          out << c;
+      }
+      out << '"';
+      break;
+    case Value::OBJ: {
+      out << '{';
+      bool first = true;
+      for (auto &kv : v.obj) {
+        if (!first)
+          out << ',';
+        first = false;
+        out << '"' << kv.first << "\":";
+        print(out, kv.second);
+      }
+      out << '}';
+      break;
+    }
+  }
+}
+
+static bool parse(const char *&p, const char *end, Value &v);
+
+static bool parse_string(const char *&p, const char *end, std::string &out) {
+  if (p == end || *p != '"')
+    return false;
+  for (++p; p < end && *p != '"'; ++p) {
+    if (*p == '\\') {
+      if (++p == end)
+        return false;
+      if (*p == 'u') {
+        if (end - p < 5)
+          return false;
+        out += (char)strtol(std::string(p + 1, 4).c_str(), nullptr, 16);
+        p += 4;
+        continue;
+      }
+    }
+    out += *p;
+  }
+  return p++ < end;
+}
+
+static bool parse(const char *&p, const char *end, Value &v) {
+  if (p == end)
+    return false;
+  if (*p == '{') {
+    v.kind = Value::OBJ;
+    if (++p < end && *p == '}')
+      return ++p, true;
+    for (;;) {
+      std::string k;
+      if (!parse_string(p, end, k) || p == end || *p++ != ':' ||
+          !parse(p, end, v.obj[k]) || p == end)
+        return false;
+      if (*p == '}')
+        return ++p, true;
+      if (*p++ != ',')
+        return false;
+    }
+  }
+  if (*p == '"') {
+    v.kind = Value::STR;
+    return parse_string(p, end, v.s);
+  }
+  if (end - p >= 4 && !memcmp(p, "true", 4)) {
+    v.kind = Value::BOOL; v.b = true; p += 4;
+    return true;
+  }
+  if (end - p >= 5 && !memcmp(p, "false", 5)) {
+    v.kind = Value::BOOL; v.b = false; p += 5;
+    return true;
+  }
+  const char *s = p;
+  while (p < end && strchr("+-.0123456789eE", *p))
+    ++p;
+  v.s.assign(s, p);
+  return p != s;
+}
+
+static const Value *get(const Value &v, const char *k) {
+  auto it = v.obj.find(k);
+  return it == v.obj.end() ? nullptr : &it->second;
+}
+
+static void from_value(const Value &v, Fill &f) {
+  if (auto x = get(v, "id")) f.id = strtoll(x->s.c_str(), nullptr, 10);
+  if (auto x = get(v, "qty")) f.qty = strtoul(x->s.c_str(), nullptr, 10);
+  if (auto x = get(v, "price")) f.price = strtod(x->s.c_str(), nullptr);
+  if (auto x = get(v, "active")) f.active = x->b;
+  if (auto x = get(v, "symbol")) f.symbol = x->s;
+  if (auto x = get(v, "venue")) f.venue = x->s;
+}
+
+static void from_value(const Value &v, Order &o) {
+  if (auto x = get(v, "id")) o.id = strtoll(x->s.c_str(), nullptr, 10);
+  if (auto x = get(v, "qty")) o.qty = strtoul(x->s.c_str(), nullptr, 10);
+  if (auto x = get(v, "price")) o.price = strtod(x->s.c_str(), nullptr);
+  if (auto x = get(v, "active")) o.active = x->b;
+  if (auto x = get(v, "symbol")) o.symbol = x->s;
+  if (auto x = get(v, "note")) o.note = x->s;
+  if (auto x = get(v, "last_fill")) from_value(*x, o.last_fill);
+  if (auto x = get(v, "flags")) o.flags = strtol(x->s.c_str(), nullptr, 10);
+}
+
+// Benchmark
+// ---------
+
+static bool same(const Fill &a, const Fill &b) {
+  return a.id == b.id && a.qty == b.qty && a.price == b.price &&
+    a.active == b.active && a.symbol == b.symbol && a.venue == b.venue;
+}
+
+static bool same(const Order &a, const Order &b) {
+  return a.id == b.id && a.qty == b.qty && a.price == b.price &&
+    a.active == b.active && a.symbol == b.symbol && a.note == b.note &&
+    same(a.last_fill, b.last_fill) && a.flags == b.flags;
+}
+
+template<typename F>
+static double time_ns(int n, F fn) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i=0; i<n; ++i)
+    fn(i);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+}
+
+static volatile size_t sink;
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 200000;
+  std::vector<Order> orders(64);
+  for (size_t i=0; i<orders.size(); ++i) {
+    Order &o = orders[i];
+    o.id = 1000000007LL * (i + 1);
+    o.qty = 100 * i + 7;
+    o.price = 101.25 + i / 3.0;
+    o.active = i & 1;
+    o.symbol = "XYZ" + std::to_string(i);
+    o.note = "limit \"day\" order\n";
+    o.last_fill.id = -(int64_t)i;
+    o.last_fill.qty = i;
+    o.last_fill.price = 0.1 * i;
+    o.last_fill.active = true;
+    o.last_fill.symbol = o.symbol;
+    o.last_fill.venue = "XNAS";
+    o.flags = -(int32_t)i;
+  }
+
+  // Check both paths round-trip every value before timing them.
+  compex_json::writer w;
+  std::vector<std::string> gen_text, generic_text;
+  for (auto &o : orders) {
+    w.clear();
+    compex_json_write(w, o);
+    gen_text.push_back(w.str());
+    std::ostringstream out;
+    print(out, to_value(o));
+    generic_text.push_back(out.str());
+
+    Order a, b;
+    compex_json::reader r(gen_text.back().data(), gen_text.back().size());
+    const char *p = generic_text.back().data();
+    Value v;
+    if (!compex_json_read(r, a) || !same(a, o) ||
+        !parse(p, p + generic_text.back().size(), v) ||
+        (from_value(v, b), !same(b, o))) {
+      fprintf(stderr, "round trip failed: %s\n", gen_text.back().c_str());
+      return 1;
+    }
+  }
+
+  size_t m = orders.size();
+  double gen_enc = time_ns(n, [&](int i) {
+    w.clear();
+    compex_json_write(w, orders[i % m]);
+    sink = w.size();
+  });
+  double generic_enc = time_ns(n, [&](int i) {
+    std::ostringstream out;
+    print(out, to_value(orders[i % m]));
+    sink = out.str().size();
+  });
+  Order o;
+  double gen_dec = time_ns(n, [&](int i) {
+    const std::string &s = gen_text[i % m];
+    compex_json::reader r(s.data(), s.size());
+    compex_json_read(r, o);
+    sink = o.qty;
+  });
+  double generic_dec = time_ns(n, [&](int i) {
+    const std::string &s = generic_text[i % m];
+    const char *p = s.data();
+    Value v;
+    parse(p, p + s.size(), v);
+    from_value(v, o);
+    sink = o.qty;
+  });
+
+  printf("%-10s %12s %12s\n", "", "encode ns", "decode ns");
+  printf("%-10s %12.1f %12.1f\n", "compex", gen_enc, gen_dec);
+  printf("%-10s %12.1f %12.1f\n", "generic", generic_enc, generic_dec);
+  printf("%-10s %11.1fx %11.1fx\n", "speedup", generic_enc / gen_enc, generic_dec / gen_dec);
+  return 0;
+}
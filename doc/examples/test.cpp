@@ -41,6 +41,11 @@ struct COMPEX_TAG() SubClass2 :public SubClass {
   ~SubClass2();
 };
 
+COMPEX_TAG("handler", "ping")
+int handle_ping(int x) {
+  return x;
+}
+
 int main(int argc, char **argv) {
   return 0;
 }
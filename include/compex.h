@@ -31,4 +31,37 @@
 #  define COMPEX_TAG(...)
 #endif
 
+/* Devirtualization hints:
+ *    COMPEX_FINAL(C) and COMPEX_FINAL_M(C, m) expand to 'final' where the
+ *    header generated by compex-devirt --hints, named by
+ *    COMPEX_DEVIRT_HINTS, says that class C or its virtual method m may be
+ *    final, and to nothing otherwise.
+ */
+#if defined(COMPEX_DEVIRT_HINTS) && defined(__cplusplus)
+#  include COMPEX_DEVIRT_HINTS
+#  define COMPEX_FINAL(C)     COMPEX_FINAL_##C
+#  define COMPEX_FINAL_M(C,m) COMPEX_FINAL_##C##__##m
+#else
+#  define COMPEX_FINAL(C)
+#  define COMPEX_FINAL_M(C,m)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Access profiling runtime:
+ *    Defined by the C file generated with compex-hotcold --runtime, for
+ *    programs built with compex-config -p. Counts are summed per thread;
+ *    each profiled worker thread should call compex_ap_thread_exit() before
+ *    it exits. compex_ap_write() writes the totals for compex-hotcold; they
+ *    are also written at exit if COMPEX_AP_OUTPUT names a file.
+ */
+void compex_ap_thread_exit(void);
+int  compex_ap_write(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
 // 2015 Hugo Landau <hlandau@devever.net>          Public Domain
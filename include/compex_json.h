@@ -0,0 +1,471 @@
+#pragma once
+/* compex_json.h
+ * -------------
+ * Support routines for the JSON encoders and decoders generated by
+ * compex-json. The generated code does the per-struct work (key fragments,
+ * field offsets, key dispatch); this header provides the writer and reader
+ * they drive and the formatting of individual values.
+ *
+ * Floats are written in the shortest form which round-trips when
+ * std::to_chars is available (C++17), and with 17 significant digits
+ * otherwise. Non-finite floats are written as null.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits>
+#include <string>
+#if __cplusplus >= 201703L && defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>
+#    if defined(__cpp_lib_to_chars) || (defined(__GLIBCXX__) && __GNUC__ >= 11)
+#      define COMPEX_JSON_TO_CHARS 1
+#    endif
+#  endif
+#endif
+
+namespace compex_json {
+
+/* writer
+ * ------
+ * Growable output buffer. reserve() returns a pointer with room for n bytes;
+ * advance() commits the bytes written up to p.
+ */
+class writer {
+public:
+  writer(size_t cap = 256) :_begin((char*)malloc(cap)), _p(_begin), _end(_begin + cap) {}
+  ~writer() { free(_begin); }
+  writer(const writer &) = delete;
+  writer &operator=(const writer &) = delete;
+
+  char *reserve(size_t n) {
+    if ((size_t)(_end - _p) < n)
+      _grow(n);
+    return _p;
+  }
+  void advance(char *p) { _p = p; }
+
+  const char *data() const { return _begin; }
+  size_t size() const { return _p - _begin; }
+  void clear() { _p = _begin; }
+  std::string str() const { return std::string(_begin, _p); }
+
+private:
+  void _grow(size_t n) {
+    size_t used = _p - _begin, cap = (_end - _begin) * 2;
+    if (cap < used + n)
+      cap = used + n;
+    _begin = (char*)realloc(_begin, cap);
+    _p = _begin + used;
+    _end = _begin + cap;
+  }
+
+  char *_begin, *_p, *_end;
+};
+
+/* Maximum bytes written by the format_* functions. */
+enum { MAX_INT_LEN = 20, MAX_FLOAT_LEN = 32, MAX_BOOL_LEN = 5 };
+
+static const char digit_pairs[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/* Number of decimal digits in v, from its bit length and a table of powers of
+ * ten rather than a loop of comparisons. */
+inline unsigned count_digits(uint64_t v) {
+  static const uint64_t pow10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+    1000000000000ull, 10000000000000ull, 100000000000000ull,
+    1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull,
+  };
+  unsigned t = ((64 - __builtin_clzll(v | 1)) * 1233) >> 12;
+  return t + ((v | 1) >= pow10[t]);
+}
+
+/* Writes v at p, returning the end. The digits are produced two at a time
+ * from the end, so the only branch is the loop bound. */
+inline char *format_u64(char *p, uint64_t v) {
+  unsigned n = count_digits(v);
+  char *q = p + n;
+  while (v >= 100) {
+    unsigned i = (unsigned)(v % 100) * 2;
+    v /= 100;
+    q -= 2;
+    memcpy(q, digit_pairs + i, 2);
+  }
+  // One or two digits remain. Index the pair so that one digit writes the
+  // second character of "0d" twice, rather than branching.
+  size_t lead = q - p;
+  p[0] = digit_pairs[v*2 + 2 - lead];
+  p[lead - 1] = digit_pairs[v*2 + 1];
+  return p + n;
+}
+
+inline char *format_i64(char *p, int64_t v) {
+  uint64_t neg = (uint64_t)v >> 63;
+  *p = '-';
+  p += neg;
+  return format_u64(p, ((uint64_t)v ^ (0 - neg)) + neg);
+}
+
+inline char *format_bool(char *p, bool v) {
+  memcpy(p, v ? "true " : "false", 5);
+  return p + 5 - v;
+}
+
+inline char *format_double(char *p, double v) {
+  if (v - v != v - v) {
+    memcpy(p, "null", 4);
+    return p + 4;
+  }
+#ifdef COMPEX_JSON_TO_CHARS
+  return std::to_chars(p, p + MAX_FLOAT_LEN, v).ptr;
+#else
+  return p + snprintf(p, MAX_FLOAT_LEN, "%.17g", v);
+#endif
+}
+
+inline char *format_float(char *p, float v) {
+  if (v - v != v - v) {
+    memcpy(p, "null", 4);
+    return p + 4;
+  }
+#ifdef COMPEX_JSON_TO_CHARS
+  return std::to_chars(p, p + MAX_FLOAT_LEN, v).ptr;
+#else
+  return p + snprintf(p, MAX_FLOAT_LEN, "%.9g", (double)v);
+#endif
+}
+
+/* Nonzero for bytes which must be escaped in a JSON string. */
+static const unsigned char escape_class[256] = {
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,
+};
+
+inline void write_string(writer &w, const char *s, size_t n) {
+  // Worst case: every byte becomes \u00XX.
+  char *p = w.reserve(n*6 + 2);
+  *p++ = '"';
+  for (size_t i=0; i<n; ++i) {
+    unsigned char c = s[i];
+    if (!escape_class[c]) {
+      *p++ = c;
+      continue;
+    }
+    *p++ = '\\';
+    switch (c) {
+      case '"':  *p++ = '"';  break;
+      case '\\': *p++ = '\\'; break;
+      case '\n': *p++ = 'n';  break;
+      case '\r': *p++ = 'r';  break;
+      case '\t': *p++ = 't';  break;
+      default:
+        memcpy(p, "u00", 3);
+        p[3] = "0123456789abcdef"[c >> 4];
+        p[4] = "0123456789abcdef"[c & 15];
+        p += 5;
+        break;
+    }
+  }
+  *p++ = '"';
+  w.advance(p);
+}
+
+inline void write_string(writer &w, const std::string &s) {
+  write_string(w, s.data(), s.size());
+}
+
+/* key_hash
+ * --------
+ * FNV-1a with a seed chosen by compex-json so that the keys of a struct
+ * hash to distinct slots.
+ */
+inline uint32_t key_hash(uint32_t seed, const char *s, size_t n) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i=0; i<n; ++i)
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+  return h;
+}
+
+/* reader
+ * ------
+ * Cursor over a JSON document. Each read_* function returns false and clears
+ * ok on malformed or out of range input.
+ */
+struct reader {
+  reader(const char *s, size_t n) :p(s), end(s + n) {}
+
+  const char *p, *end;
+  bool ok = true;
+
+  bool fail() { ok = false; return false; }
+
+  void skip_ws() {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+      ++p;
+  }
+
+  bool expect(char c) {
+    skip_ws();
+    if (p == end || *p != c)
+      return fail();
+    ++p;
+    return true;
+  }
+
+  bool begin_object() { return expect('{'); }
+
+  /* Reads the next key of an object, returning its raw (unescaped) bytes, or
+   * returns false at the closing brace or on error. first must be true on the
+   * first call for an object. */
+  bool next_key(const char *&k, size_t &n, bool &first) {
+    skip_ws();
+    if (p < end && *p == '}') {
+      ++p;
+      return false;
+    }
+    if (!first && !expect(','))
+      return false;
+    first = false;
+    if (!expect('"'))
+      return false;
+    k = p;
+    while (p < end && *p != '"')
+      p += (*p == '\\') ? 2 : 1;
+    if (p >= end)
+      return fail();
+    n = p++ - k;
+    return expect(':');
+  }
+
+  template<typename T>
+  bool read_int(T &out) {
+    skip_ws();
+    bool neg = p < end && *p == '-';
+    p += neg;
+    if (p == end || (unsigned)(*p - '0') > 9)
+      return fail();
+    uint64_t v = 0;
+    for (; p < end && (unsigned)(*p - '0') <= 9; ++p) {
+      unsigned d = *p - '0';
+      if (v > UINT64_MAX / 10 || (v == UINT64_MAX / 10 && d > UINT64_MAX % 10))
+        return fail();
+      v = v*10 + d;
+    }
+    if (neg) {
+      if (!std::numeric_limits<T>::is_signed
+          || v > (uint64_t)std::numeric_limits<T>::max() + 1)
+        return fail();
+      out = (T)(0 - v);
+    } else {
+      if (v > (uint64_t)std::numeric_limits<T>::max())
+        return fail();
+      out = (T)v;
+    }
+    return true;
+  }
+
+  bool read_bool(bool &out) {
+    skip_ws();
+    if (end - p >= 4 && !memcmp(p, "true", 4)) {
+      out = true;
+      p += 4;
+    } else if (end - p >= 5 && !memcmp(p, "false", 5)) {
+      out = false;
+      p += 5;
+    } else
+      return fail();
+    return true;
+  }
+
+  template<typename T>
+  bool read_float(T &out) {
+    skip_ws();
+    if (end - p >= 4 && !memcmp(p, "null", 4)) {
+      out = std::numeric_limits<T>::quiet_NaN();
+      p += 4;
+      return true;
+    }
+#ifdef COMPEX_JSON_TO_CHARS
+    auto r = std::from_chars(p, end, out);
+    if (r.ec != std::errc())
+      return fail();
+    p = r.ptr;
+#else
+    char buf[64];
+    size_t n = end - p < 63 ? end - p : 63;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    char *e;
+    out = (T)strtod(buf, &e);
+    if (e == buf)
+      return fail();
+    p += e - buf;
+#endif
+    return true;
+  }
+
+  bool read_string(std::string &out) {
+    if (!expect('"'))
+      return false;
+    out.clear();
+    const char *s = p;
+    while (p < end && *p != '"') {
+      if (*p != '\\') {
+        ++p;
+        continue;
+      }
+      out.append(s, p);
+      if (++p == end)
+        return fail();
+      switch (*p++) {
+        case '"':  out += '"';  break;
+        case '\\': out += '\\'; break;
+        case '/':  out += '/';  break;
+        case 'b':  out += '\b'; break;
+        case 'f':  out += '\f'; break;
+        case 'n':  out += '\n'; break;
+        case 'r':  out += '\r'; break;
+        case 't':  out += '\t'; break;
+        case 'u': {
+          unsigned cp = 0;
+          if (!_read_hex4(cp))
+            return false;
+          if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+            unsigned lo = 0;
+            p += 2;
+            if (!_read_hex4(lo))
+              return false;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+          }
+          _append_utf8(out, cp);
+          break;
+        }
+        default:
+          return fail();
+      }
+      s = p;
+    }
+    if (p == end)
+      return fail();
+    out.append(s, p++);
+    return true;
+  }
+
+  /* Skips over a value of any type. Nested arrays and objects are tracked
+   * with a stack of closing brackets rather than by recursion, and input
+   * nested more deeply than MAX_SKIP_DEPTH is rejected. */
+  enum { MAX_SKIP_DEPTH = 128 };
+
+  bool skip_value() {
+    char stack[MAX_SKIP_DEPTH];
+    unsigned depth = 0;
+    for (;;) {
+      skip_ws();
+      if (p == end)
+        return fail();
+      if (*p == '{' || *p == '[') {
+        char close = *p == '{' ? '}' : ']';
+        ++p;
+        skip_ws();
+        if (p < end && *p == close) {
+          ++p;
+        } else {
+          if (depth == MAX_SKIP_DEPTH)
+            return fail();
+          stack[depth++] = close;
+          if (close == '}' && !_skip_key())
+            return false;
+          continue;
+        }
+      } else if (*p == '"') {
+        if (!_skip_string())
+          return false;
+      } else {
+        const char *s = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' '
+            && *p != '\n' && *p != '\r' && *p != '\t')
+          ++p;
+        if (p == s)
+          return fail();
+      }
+
+      // A value is complete: close any finished containers, then move on to
+      // the next element of the innermost open one.
+      for (;;) {
+        if (depth == 0)
+          return true;
+        skip_ws();
+        if (p < end && *p == stack[depth-1]) {
+          ++p;
+          --depth;
+          continue;
+        }
+        if (!expect(','))
+          return false;
+        if (stack[depth-1] == '}' && !_skip_key())
+          return false;
+        break;
+      }
+    }
+  }
+
+private:
+  bool _skip_string() {
+    for (++p; p < end && *p != '"'; p += (*p == '\\') ? 2 : 1)
+      ;
+    if (p >= end)
+      return fail();
+    ++p;
+    return true;
+  }
+
+  bool _skip_key() {
+    skip_ws();
+    if (p == end || *p != '"')
+      return fail();
+    return _skip_string() && expect(':');
+  }
+
+  bool _read_hex4(unsigned &cp) {
+    if (end - p < 4)
+      return fail();
+    for (int i=0; i<4; ++i) {
+      char c = *p++;
+      cp <<= 4;
+      if (c >= '0' && c <= '9')      cp |= c - '0';
+      else if (c >= 'a' && c <= 'f') cp |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') cp |= c - 'A' + 10;
+      else                           return fail();
+    }
+    return true;
+  }
+
+  static void _append_utf8(std::string &out, unsigned cp) {
+    if (cp < 0x80) {
+      out += (char)cp;
+    } else if (cp < 0x800) {
+      out += (char)(0xC0 | (cp >> 6));
+      out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += (char)(0xE0 | (cp >> 12));
+      out += (char)(0x80 | ((cp >> 6) & 0x3F));
+      out += (char)(0x80 | (cp & 0x3F));
+    } else {
+      out += (char)(0xF0 | (cp >> 18));
+      out += (char)(0x80 | ((cp >> 12) & 0x3F));
+      out += (char)(0x80 | ((cp >> 6) & 0x3F));
+      out += (char)(0x80 | (cp & 0x3F));
+    }
+  }
+};
+
+} // namespace compex_json
+
+// 2015 Hugo Landau <hlandau@devever.net>          Public Domain
@@ -0,0 +1,61 @@
+#pragma once
+/* compex_registry.h
+ * -----------------
+ * Lookup of the function registry generated by compex-convert -r.
+ */
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function registry:
+ *    compex-convert -r turns the !compex/function records for tagged free
+ *    functions into a translation unit defining compex_functions[]. The
+ *    table is sorted by qualified name (overloads are adjacent) and consists
+ *    only of constant expressions, so it is constant-initialized and needs no
+ *    global constructors. fn is null for internal or inline functions and
+ *    must be cast to the function's real type before calling.
+ */
+struct compex_tag_value {
+  const char *str;          /* null for integer values */
+  long        num;
+};
+
+struct compex_tag {
+  const struct compex_tag_value *values;
+  unsigned                       num_values;
+};
+
+struct compex_function {
+  const char              *name;
+  const char              *asm_name;
+  void                   (*fn)(void);
+  const struct compex_tag *tags;
+  unsigned                 num_tags;
+};
+
+extern const struct compex_function compex_functions[];
+extern const unsigned compex_num_functions;
+
+/* Returns the first registry entry with the given qualified name, or null. */
+static inline const struct compex_function *
+compex_find_function(const char *name) {
+  unsigned lo = 0, hi = compex_num_functions;
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo)/2;
+    if (strcmp(compex_functions[mid].name, name) < 0)
+      lo = mid+1;
+    else
+      hi = mid;
+  }
+  if (lo < compex_num_functions && !strcmp(compex_functions[lo].name, name))
+    return &compex_functions[lo];
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+// 2015 Hugo Landau <hlandau@devever.net>          Public Domain
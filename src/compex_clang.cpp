@@ -14,6 +14,14 @@
  *
  *   a            Print information about all types, not just tagged types.
  *
+ *   lint         Check structures tagged ("hot") for copies hidden in moves.
+ *                See compex_gcc.cpp for the checks performed.
+ *
+ *   append       Append the output for the translation unit to the output
+ *                file as a single checksummed frame, so that concurrent
+ *                compilations may share one file. See compex_gcc.cpp for the
+ *                frame format. Requires o.
+ *
  * Supported attributes:
  *
  *   __attribute__((annotate("compex_tag ...")))
@@ -29,6 +37,15 @@
  *     When used on structures, this also indicates that the structure's type
  *     information should be dumped. Structures are not dumped by default.
  *
+ *     The max_size, max_padding and cacheline_aligned tags declare layout
+ *     budgets on structures, as described in compex_gcc.cpp. Violations are
+ *     reported as errors with a per-field breakdown of the layout. As the
+ *     annotation holds only the source text of the arguments, byte counts
+ *     must be integer literals under clang, not expressions like sizeof(X).
+ *
+ *     When used on free functions, the function is dumped as a
+ *     !compex/function record keyed by its mangled name.
+ *
  */
 
 #define __STDC_CONSTANT_MACROS
@@ -37,9 +54,18 @@
 #include <clang/Frontend/FrontendPluginRegistry.h>
 #include <clang/AST/AST.h>
 #include <clang/AST/ASTConsumer.h>
+#include <clang/AST/Mangle.h>
+#include <clang/AST/RecordLayout.h>
 #include <clang/Frontend/CompilerInstance.h>
+#include <clang/Sema/Sema.h>
 #include <llvm/Support/raw_ostream.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
 #include <tuple>
+#include <unordered_set>
+#include <vector>
 
 #define BEGIN_NS(X) namespace X {
 #define END_NS }
@@ -54,14 +80,32 @@ struct Consumer :public ASTConsumer {
   Consumer(CompilerInstance &ci, raw_ostream *out);
 
   virtual bool HandleTopLevelDecl(DeclGroupRef dg);
+  virtual void HandleTagDeclDefinition(TagDecl *d);
+  virtual void HandleTranslationUnit(ASTContext &ctx);
   void SetDumpAll(bool dumpAll);
+  void SetFrameOutput(const std::string &fn);
+  void SetLint(bool lint);
 
 protected:
   raw_ostream &_Indent();
   bool _ShouldDump(const NamedDecl *d);
   void _HandleLocation(SourceLocation loc);
   void _HandleAttrs(const Decl *d);
+  std::string _MangledName(const NamedDecl *d);
+  bool _FindTag(const Decl *d, StringRef name, std::vector<std::string> &args);
+  void _CheckBudgets(const RecordDecl *d);
+  void _LintCopyMove(const RecordDecl *d);
+  bool _IsNothrow(const CXXConstructorDecl *c);
+
+  struct LayoutEntry {
+    uint64_t offset, size;    // bits
+    std::string desc;
+    SourceLocation loc;
+    bool operator<(const LayoutEntry &o) const { return offset < o.offset; }
+  };
+  uint64_t _WalkLayout(const RecordDecl *d, bool breakdown);
 
+  void _HandleDecl(const Decl *d);
   void _HandleNamedDecl(const NamedDecl *d);
   void _HandleRecordDecl(const RecordDecl *d);
   void _HandleFieldDecl(const FieldDecl *d);
@@ -81,14 +125,21 @@ protected:
 
   CompilerInstance &_ci;
   ASTContext &_ctx;
+  std::unique_ptr<MangleContext> _mangler;
   raw_ostream *_out;
   int _indent;
   bool _dumpAll = false;
+  bool _lint = false;
+  std::string _frameFn, _frameBuf;
+  std::unordered_set<const Decl*> _dumpedFunctions;
+  std::vector<const RecordDecl*> _lintRecords;
+  std::unique_ptr<llvm::raw_string_ostream> _frameOut;
 };
 #define INDENT_SCOPE() indent _indenter(*this)
 
 Consumer::Consumer(CompilerInstance &ci, raw_ostream *out)
-  :_ci(ci), _ctx(ci.getASTContext()), _indent(0), _out(out) {}
+  :_ci(ci), _ctx(ci.getASTContext()), _mangler(_ctx.createMangleContext()),
+   _indent(0), _out(out) {}
 
 raw_ostream &Consumer::_Indent() {
   for (int i=0; i<_indent; ++i)
@@ -100,24 +151,374 @@ void Consumer::SetDumpAll(bool dumpAll) {
   _dumpAll = dumpAll;
 }
 
-bool Consumer::HandleTopLevelDecl(DeclGroupRef dg) {
-  for (const Decl *d :dg) {
-    const NamedDecl *nd = dyn_cast<NamedDecl>(d);
-    if (!nd)
-      continue;
-    _HandleNamedDecl(nd);
+void Consumer::SetLint(bool lint) {
+  _lint = lint;
+}
+
+void Consumer::SetFrameOutput(const std::string &fn) {
+  _frameFn = fn;
+  _frameOut.reset(new llvm::raw_string_ostream(_frameBuf));
+  _out = _frameOut.get();
+}
+
+static uint32_t _Crc32(const std::string &s) {
+  uint32_t c = 0xFFFFFFFF;
+  for (unsigned char ch :s) {
+    c ^= ch;
+    for (int k=0; k<8; ++k)
+      c = (c >> 1) ^ (0xEDB88320 & -(c & 1));
+  }
+  return ~c;
+}
+
+void Consumer::HandleTranslationUnit(ASTContext &ctx) {
+  for (const RecordDecl *d :_lintRecords)
+    _LintCopyMove(d);
+
+  if (_frameFn.empty())
+    return;
+
+  // The frame is written with a single O_APPEND write so that it cannot be
+  // interleaved with frames from concurrent compilers. A short write leaves
+  // a truncated frame, which readers skip.
+  _frameOut->flush();
+  char hdr[33];
+  snprintf(hdr, sizeof(hdr), "%%compex-frame %08x %08x\n",
+    (unsigned)_frameBuf.size(), (unsigned)_Crc32(_frameBuf));
+  std::string frame = hdr + _frameBuf;
+
+  int fd = ::open(_frameFn.c_str(), O_WRONLY|O_APPEND|O_CREAT, 0666);
+  ssize_t n = -1;
+  if (fd >= 0) {
+    n = ::write(fd, frame.data(), frame.size());
+    ::close(fd);
   }
+  if (n != (ssize_t)frame.size())
+    llvm::errs() << "compex_clang: Could not append output frame to " << _frameFn << "\n";
+}
+
+bool Consumer::HandleTopLevelDecl(DeclGroupRef dg) {
+  for (const Decl *d :dg)
+    _HandleDecl(d);
 
   _out->flush();
   return true;
 }
 
+// Namespaces and linkage specifications are passed whole once they are
+// closed, so descend into them to find the declarations they contain.
+void Consumer::_HandleDecl(const Decl *d) {
+  if (isa<NamespaceDecl>(d) || isa<LinkageSpecDecl>(d)) {
+    for (const Decl *c :cast<DeclContext>(d)->decls())
+      _HandleDecl(c);
+    return;
+  }
+
+  if (auto nd = dyn_cast<NamedDecl>(d))
+    _HandleNamedDecl(nd);
+}
+
+// Budgets are checked for every record definition, including those in
+// namespaces and nested classes, which HandleTopLevelDecl does not reach.
+// Looking up the copy and move constructors declares them if they are
+// implicit, which would change the methods output, so the lint waits for
+// the end of the translation unit.
+void Consumer::HandleTagDeclDefinition(TagDecl *d) {
+  auto rd = dyn_cast<RecordDecl>(d);
+  if (!rd)
+    return;
+
+  _CheckBudgets(rd);
+  if (_lint)
+    _lintRecords.push_back(rd);
+}
+
+/* Returns s as a double-quoted YAML scalar. */
+static std::string _Quoted(StringRef s) {
+  std::string out = "\"";
+  for (char c :s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
 void Consumer::_HandleLocation(SourceLocation loc) {
   auto &smgr = _ci.getSourceManager();
   _Indent() << "$srcFile: " << smgr.getBufferName(loc) << "\n";
   _Indent() << "$srcLine: " << smgr.getSpellingLineNumber(loc) << "\n";
 }
 
+std::string Consumer::_MangledName(const NamedDecl *nd) {
+  if (!_mangler->shouldMangleDeclName(nd))
+    return nd->getNameAsString();
+
+  std::string name;
+  llvm::raw_string_ostream os(name);
+  _mangler->mangleName(nd, os);
+  return os.str();
+}
+
+bool Consumer::_FindTag(const Decl *d, StringRef name, std::vector<std::string> &args) {
+  for (const Attr *a :d->attrs()) {
+    auto aa = dyn_cast<AnnotateAttr>(a);
+    if (!aa || !aa->getAnnotation().startswith("compex_tag"))
+      continue;
+
+    // The annotation is the stringified tag argument list, e.g.
+    // compex_tag "max_size", 64
+    StringRef v = aa->getAnnotation().substr(10);
+    args.clear();
+    while (!(v = v.ltrim(" \t,")).empty()) {
+      std::string arg;
+      if (v[0] == '"') {
+        size_t i = 1;
+        for (; i < v.size() && v[i] != '"'; ++i) {
+          if (v[i] == '\\' && i+1 < v.size())
+            ++i;
+          arg += v[i];
+        }
+        v = v.substr(i+1);
+      } else {
+        size_t i = v.find(',');
+        arg = v.substr(0, i).rtrim();
+        v = v.substr(i == StringRef::npos ? v.size() : i);
+      }
+      args.push_back(arg);
+    }
+
+    if (args.size() && args[0] == name)
+      return true;
+  }
+
+  return false;
+}
+
+/* Parses an integer tag argument. The annotation holds the source text of
+ * the arguments, so only integer literals (with any suffix) can be read; an
+ * expression such as sizeof(X) is rejected. */
+static bool _TagInt(const std::string &arg, int64_t &out) {
+  StringRef v = StringRef(arg).rtrim("uUlL");
+  return !v.empty() && !v.getAsInteger(0, out);
+}
+
+uint64_t Consumer::_WalkLayout(const RecordDecl *d, bool breakdown) {
+  const ASTRecordLayout &layout = _ctx.getASTRecordLayout(d);
+  auto cxx_d = dyn_cast<CXXRecordDecl>(d);
+  std::vector<LayoutEntry> entries;
+
+  if (cxx_d) {
+    if (cxx_d->isDynamicClass() && !layout.getPrimaryBase())
+      entries.push_back({0, _ctx.getTargetInfo().getPointerWidth(0), "vptr", d->getLocation()});
+
+    for (const CXXBaseSpecifier &b :cxx_d->bases()) {
+      if (b.isVirtual())
+        continue;
+      auto bd = b.getType()->getAsCXXRecordDecl();
+      CharUnits size = _ctx.getASTRecordLayout(bd).getNonVirtualSize();
+      entries.push_back({(uint64_t)_ctx.toBits(layout.getBaseClassOffset(bd)),
+        (uint64_t)_ctx.toBits(size), "base " + b.getType().getAsString(), b.getLocStart()});
+    }
+
+    // Virtual bases, direct and indirect, are laid out once in the most
+    // derived class, so each is listed once here rather than under the bases
+    // above. A virtual primary base is at offset 0 and holds the vptr, and
+    // overlapping entries are only counted once below.
+    for (const CXXBaseSpecifier &b :cxx_d->vbases()) {
+      auto bd = b.getType()->getAsCXXRecordDecl();
+      CharUnits size = _ctx.getASTRecordLayout(bd).getNonVirtualSize();
+      entries.push_back({(uint64_t)_ctx.toBits(layout.getVBaseClassOffset(bd)),
+        (uint64_t)_ctx.toBits(size), "virtual base " + b.getType().getAsString(), b.getLocStart()});
+    }
+  }
+
+  for (const FieldDecl *f :d->fields()) {
+    uint64_t size = f->isBitField() ? f->getBitWidthValue(_ctx) : _ctx.getTypeSize(f->getType());
+    entries.push_back({layout.getFieldOffset(f->getFieldIndex()), size,
+      "'" + f->getNameAsString() + "'", f->getLocation()});
+  }
+
+  std::stable_sort(entries.begin(), entries.end());
+
+  DiagnosticsEngine &diags = _ci.getDiagnostics();
+  unsigned fieldID = diags.getCustomDiagID(DiagnosticsEngine::Note, "%0: offset %1, %2 bytes");
+  unsigned bitsID  = diags.getCustomDiagID(DiagnosticsEngine::Note, "%0: bit offset %1, %2 bits");
+  unsigned holeID  = diags.getCustomDiagID(DiagnosticsEngine::Note, "%0 bits of padding before this field");
+  unsigned tailID  = diags.getCustomDiagID(DiagnosticsEngine::Note, "%0 bits of tail padding");
+
+  uint64_t end = 0, covered = 0;
+  uint64_t size = _ctx.toBits(layout.getSize());
+  for (const LayoutEntry &e :entries) {
+    if (breakdown && e.offset > end)
+      diags.Report(e.loc, holeID) << (unsigned)(e.offset - end);
+
+    if (breakdown) {
+      if (e.offset % 8 || e.size % 8)
+        diags.Report(e.loc, bitsID) << e.desc << (unsigned)e.offset << (unsigned)e.size;
+      else
+        diags.Report(e.loc, fieldID) << e.desc << (unsigned)(e.offset/8) << (unsigned)(e.size/8);
+    }
+
+    if (e.offset + e.size > end) {
+      covered += e.offset + e.size - std::max(e.offset, end);
+      end = e.offset + e.size;
+    }
+  }
+
+  if (breakdown && size > end)
+    diags.Report(d->getLocation(), tailID) << (unsigned)(size - end);
+
+  return size - covered;
+}
+
+void Consumer::_CheckBudgets(const RecordDecl *d) {
+  auto cxx_d = dyn_cast<CXXRecordDecl>(d);
+  if (d->isInvalidDecl() || (cxx_d && cxx_d->isDependentType()))
+    return;
+
+  DiagnosticsEngine &diags = _ci.getDiagnostics();
+  const ASTRecordLayout &layout = _ctx.getASTRecordLayout(d);
+  uint64_t size = layout.getSize().getQuantity();
+  uint64_t align = layout.getAlignment().getQuantity();
+  std::vector<std::string> args;
+  int64_t limit;
+  bool failed = false;
+
+  if (_FindTag(d, "max_size", args)) {
+    if (args.size() < 2 || !_TagInt(args[1], limit) || limit < 0) {
+      diags.Report(d->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Error,
+        "compex: 'max_size' tag requires a byte count given as an integer literal"));
+    } else if (size > (uint64_t)limit) {
+      diags.Report(d->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Error,
+        "compex: %0 is %1 bytes, exceeding its max_size budget of %2 bytes"))
+        << d->getName() << (unsigned)size << (unsigned)limit;
+      failed = true;
+    }
+  }
+
+  if (_FindTag(d, "max_padding", args)) {
+    uint64_t padding = _WalkLayout(d, false) / 8;
+    if (args.size() < 2 || !_TagInt(args[1], limit) || limit < 0) {
+      diags.Report(d->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Error,
+        "compex: 'max_padding' tag requires a byte count given as an integer literal"));
+    } else if (padding > (uint64_t)limit) {
+      diags.Report(d->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Error,
+        "compex: %0 has %1 bytes of padding, exceeding its max_padding budget of %2 bytes"))
+        << d->getName() << (unsigned)padding << (unsigned)limit;
+      failed = true;
+    }
+  }
+
+  if (_FindTag(d, "cacheline_aligned", args)) {
+    if (args.size() < 2 || !_TagInt(args[1], limit))
+      limit = 64;
+    if (align < (uint64_t)limit) {
+      diags.Report(d->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Error,
+        "compex: %0 has alignment %1, but is tagged cacheline_aligned (%2 bytes)"))
+        << d->getName() << (unsigned)align << (unsigned)limit;
+      failed = true;
+    }
+  }
+
+  if (failed)
+    _WalkLayout(d, true);
+}
+
+bool Consumer::_IsNothrow(const CXXConstructorDecl *c) {
+  auto fpt = c->getType()->castAs<FunctionProtoType>();
+  fpt = _ci.getSema().ResolveExceptionSpec(c->getLocation(), fpt);
+  return fpt && fpt->isNothrow(_ctx);
+}
+
+void Consumer::_LintCopyMove(const RecordDecl *d) {
+  auto cxx_d = dyn_cast<CXXRecordDecl>(d);
+  std::vector<std::string> args;
+  if (!cxx_d || cxx_d->isDependentType() || !_ci.hasSema() || !_FindTag(d, "hot", args))
+    return;
+
+  bool contiguous = std::find(args.begin(), args.end(), "contiguous") != args.end();
+  Sema &sema = _ci.getSema();
+  DiagnosticsEngine &diags = _ci.getDiagnostics();
+  auto rd = const_cast<CXXRecordDecl*>(cxx_d);
+
+  // Overload resolution for an rvalue picks the copy constructor when there
+  // is no move constructor.
+  CXXConstructorDecl *mv = sema.LookupMovingConstructor(rd, 0);
+  CXXConstructorDecl *cp = sema.LookupCopyingConstructor(rd, Qualifiers::Const);
+  bool isCopy = !mv || mv->isCopyConstructor();
+  // Implicit and defaulted constructors copy or move field by field.
+  bool implicitCopy = cp && !cp->isUserProvided() && !cp->isDeleted();
+  bool memberwiseMove = mv && !isCopy && !mv->isUserProvided() && !mv->isDeleted();
+
+  if (mv && !isCopy && mv->isDeleted()) {
+    diags.Report(mv->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Warning,
+      "compex: hot type %0 has a deleted move constructor")) << d->getName();
+  } else if (isCopy && cxx_d->hasNonTrivialCopyConstructor()) {
+    diags.Report(d->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Warning,
+      "compex: hot type %0 has no move constructor, so moving it runs its non-trivial "
+      "copy constructor")) << d->getName();
+
+    unsigned noteID = diags.getCustomDiagID(DiagnosticsEngine::Note,
+      "the implicit move constructor is suppressed by this declaration");
+    if (cxx_d->hasUserDeclaredDestructor() && cxx_d->getDestructor())
+      diags.Report(cxx_d->getDestructor()->getLocation(), noteID);
+    for (const CXXConstructorDecl *c :cxx_d->ctors())
+      if (c->isCopyConstructor() && !c->isImplicit())
+        diags.Report(c->getLocation(), noteID);
+    for (const CXXMethodDecl *m :cxx_d->methods())
+      if (m->isCopyAssignmentOperator() && !m->isImplicit())
+        diags.Report(m->getLocation(), noteID);
+  } else if (mv && !isCopy && !mv->isImplicit() && !_IsNothrow(mv)) {
+    diags.Report(mv->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Warning,
+      "compex: move constructor of hot type %0 is not noexcept, so std::vector "
+      "reallocation will copy instead")) << d->getName();
+  }
+
+  // For an implicit or defaulted move or copy, the cost comes from the
+  // fields and bases, so name them.
+  struct Part {
+    SourceLocation loc;
+    std::string desc;
+    QualType type;
+  };
+  std::vector<Part> parts;
+  for (const FieldDecl *f :d->fields())
+    parts.push_back({f->getLocation(), "'" + f->getNameAsString() + "'", f->getType()});
+  for (const CXXBaseSpecifier &b :cxx_d->bases())
+    parts.push_back({b.getLocStart(), "its base", b.getType()});
+
+  for (const Part &p :parts) {
+    auto frd = p.type->getBaseElementTypeUnsafe()->getAsCXXRecordDecl();
+    if (!frd || !frd->hasDefinition() || frd->isDependentType())
+      continue;
+
+    CXXConstructorDecl *fmv = sema.LookupMovingConstructor(frd, 0);
+    bool fIsCopy = !fmv || fmv->isCopyConstructor();
+
+    if (memberwiseMove) {
+      if (fIsCopy && frd->hasNonTrivialCopyConstructor())
+        diags.Report(p.loc, diags.getCustomDiagID(DiagnosticsEngine::Warning,
+          "compex: moving hot type %0 copies %1, as %2 has no move constructor"))
+          << d->getName() << p.desc << p.type;
+      else if (fmv && !_IsNothrow(fmv) && !_IsNothrow(mv))
+        diags.Report(p.loc, diags.getCustomDiagID(DiagnosticsEngine::Warning,
+          "compex: move constructor of hot type %0 is not noexcept because that of %1 (%2) "
+          "is not; std::vector reallocation will copy"))
+          << d->getName() << p.desc << p.type;
+    }
+
+    if (implicitCopy && (contiguous || isCopy) && frd->hasNonTrivialCopyConstructor())
+      diags.Report(p.loc, diags.getCustomDiagID(DiagnosticsEngine::Warning,
+        "compex: copying hot type %0 runs the non-trivial copy constructor of %1 (%2)"))
+        << d->getName() << p.desc << p.type;
+  }
+
+  if (contiguous && cxx_d->hasNonTrivialCopyConstructor() && cp && !implicitCopy)
+    diags.Report(cp->getLocation(), diags.getCustomDiagID(DiagnosticsEngine::Warning,
+      "compex: contiguous hot type %0 has a user-provided copy constructor")) << d->getName();
+}
+
 bool Consumer::_ShouldDump(const NamedDecl *nd) {
   if (_dumpAll)
     return true;
@@ -154,10 +555,25 @@ void Consumer::_HandleNamedDecl(const NamedDecl *nd) {
     }
     case Decl::Function:
     {
-      _Indent() << nd->getNameAsString() << ": !compex/function\n";
+      // A declaration and a later definition share a mangled name, so
+      // output each function once.
       auto f = dyn_cast<FunctionDecl>(nd);
-      if (f)
-        _HandleFunctionDecl(f);
+      if (!_dumpedFunctions.insert(f->getCanonicalDecl()).second)
+        return;
+      std::string mangled = _MangledName(f);
+      _Indent() << mangled << ": !compex/function\n";
+      {
+        INDENT_SCOPE();
+        _HandleLocation(f->getLocation());
+        _Indent() << "asm: " << mangled << "\n";
+        _Indent() << "qualname: " << _Quoted(f->getQualifiedNameAsString()) << "\n";
+        if (!f->isExternallyVisible())
+          _Indent() << "internal: true\n";
+        if (f->isInlined())
+          _Indent() << "inline: true\n";
+      }
+      _HandleFunctionDecl(f);
+      break;
     }
     default:
       return;
@@ -309,11 +725,21 @@ protected:
   llvm::raw_fd_ostream *_outfd;
   llvm::raw_ostream *_out;
   bool _dumpAll = false;
+  bool _append = false;
+  bool _lint = false;
 };
 
 ASTConsumer
 *Plugin::CreateASTConsumer(CompilerInstance &ci, llvm::StringRef x) {
   std::string errinfo;
+  if (_append) {
+    auto c = new Consumer(ci, NULL);
+    c->SetFrameOutput(_outputfn);
+    c->SetDumpAll(_dumpAll);
+    c->SetLint(_lint);
+    return c;
+  }
+
   if (_outputfn.size()) {
     _outfd = new llvm::raw_fd_ostream(_outputfn.c_str(), errinfo, llvm::sys::fs::F_None);
     _out = _outfd;
@@ -329,6 +755,8 @@ ASTConsumer
 
   if (_dumpAll)
     c->SetDumpAll(true);
+  if (_lint)
+    c->SetLint(true);
 
   return c;
 }
@@ -346,10 +774,19 @@ bool Plugin::ParseArgs(
       _outputfn = arg.substr(3);
     } else if (arg == "-a")
       _dumpAll = true;
+    else if (arg == "-append")
+      _append = true;
+    else if (arg == "-lint")
+      _lint = true;
     else
       PrintHelp(llvm::errs());
   }
 
+  if (_append && !_outputfn.size()) {
+    llvm::errs() << "compex_clang: -append requires an output filename\n";
+    return false;
+  }
+
   return true;
 }
 
@@ -360,6 +797,11 @@ void Plugin::PrintHelp(llvm::raw_ostream &ros) {
   ros << "    Write YAML output to the specified file instead of stdout.\n";
   ros << "  [-Xclang] -plugin-arg-compex_clang [-Xclang] -a\n";
   ros << "    Dump information for all types, not just tagged types.\n";
+  ros << "  [-Xclang] -plugin-arg-compex_clang [-Xclang] -lint\n";
+  ros << "    Warn about copies hidden in the moves of types tagged (\"hot\").\n";
+  ros << "  [-Xclang] -plugin-arg-compex_clang [-Xclang] -append\n";
+  ros << "    Append output to the -o file as one frame per translation unit, so that\n";
+  ros << "    concurrent compilations can share the file.\n";
   ros << "\n";
 }
 
@@ -10,6 +10,36 @@
  *   o=filename   Specify output filename for type information.
  *                Written to stdout if not specified or if specified as "-".
  *
+ *   append       Append to the output file instead of truncating it, so that
+ *                concurrent compilations may share one file. The output for
+ *                the whole translation unit is buffered and appended as a
+ *                single frame by a single O_APPEND write:
+ *
+ *                  %compex-frame <length> <crc32>\n<YAML>
+ *
+ *                where length and crc32 (of the YAML payload) are 8 hex
+ *                digits. The compex-* tools read such files, skipping any
+ *                damaged or truncated frames. Requires o.
+ *
+ *   lint         Check structures tagged ("hot") for copies hidden in moves:
+ *                a move which falls back to a non-trivial copy (because the
+ *                move constructor is missing or deleted, or because a field
+ *                has no move constructor), and a move constructor which is
+ *                not noexcept, which makes std::vector reallocation copy.
+ *                Structures tagged ("hot", "contiguous") must also have a
+ *                trivial copy constructor. Findings are warnings naming the
+ *                field responsible.
+ *
+ *   p            Instrument field accesses of structures tagged
+ *                ("access_profile"). Each read or write of a field through a
+ *                COMPONENT_REF increments a per-thread counter in the array
+ *                __compex_ap_<type>_<n>, two counters (read, write) per field
+ *                in declaration order, where <type> is the mangled type and
+ *                <n> the number of fields, so that a layout mismatch between
+ *                translation units fails to link. The array name is output as
+ *                $apSymbol. The arrays are defined by the runtime generated
+ *                with compex-hotcold --runtime.
+ *
  * Supported attributes:
  *
  *   __attribute__((compex_tag(...)))
@@ -26,6 +56,19 @@
  *     When used on structures, this also indicates that the structure's type
  *     information should be dumped. Structures are not dumped by default.
  *
+ *     Some tags on structures declare layout budgets which are enforced at
+ *     compile time; a violation is a hard error with a per-field breakdown:
+ *
+ *       ("max_size", N)            sizeof must not exceed N bytes.
+ *       ("max_padding", N)         Padding (including tail padding) must not
+ *                                  exceed N bytes.
+ *       ("cacheline_aligned"[, N]) alignof must be at least N bytes
+ *                                  (default 64).
+ *
+ *     When used on free functions, information about the function (including
+ *     its assembler name) is dumped as a !compex/function record keyed by the
+ *     assembler name. Untagged free functions are never dumped.
+ *
  */
 #include "config.h"
 #include "gcc-plugin.h"
@@ -35,8 +78,23 @@
 #include "plugin.h"
 #include "plugin-version.h"
 #include "intl.h"
+#include "langhooks.h"
+#include "basic-block.h"
+#include "tree-ssa-alias.h"
+#include "internal-fn.h"
+#include "gimple-expr.h"
+#include "is-a.h"
+#include "gimple.h"
+#include "gimple-iterator.h"
+#include "tree-pass.h"
+#include "context.h"
+#include "stringpool.h"
+#include "varasm.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 
 #define VERSION "compex_gcc v1"
@@ -46,12 +104,33 @@
 static uint32_t _counter = 0;
 static FILE *_output_f = stdout;
 static bool _dumpall = false;
+static bool _profile = false;
+static bool _lint = false;
+static const char *_output_fn = NULL;
+static bool _append = false;
+static char *_frame_buf = NULL;
+static size_t _frame_len = 0;
 
 static void _indent(int n) {
   for (int i=0;i<n;++i)
     fprintf(_output_f, "  ");
 }
 
+/* _out_quoted
+ * -----------
+ * Output a string as a double-quoted YAML scalar. Names printed by GCC may
+ * contain YAML indicators, as in {anonymous}::f.
+ */
+static void _out_quoted(const char *s) {
+  fputc('"', _output_f);
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', _output_f);
+    fputc(*s, _output_f);
+  }
+  fputc('"', _output_f);
+}
+
 static const char *_access_to_str(void *access) {
        if (access == access_public_node)      return "public";
   else if (access == access_protected_node)   return "protected";
@@ -153,6 +232,279 @@ const char *_mangle_typename_ref(tree type) {
     return NULL;
 }
 
+/* _find_tag
+ * ---------
+ * Returns the argument list of the first compex_tag attribute on a type whose
+ * first argument is the given string, or NULL_TREE if there is none.
+ */
+static tree
+_find_tag(tree type, const char *name) {
+  for (tree tag = lookup_attribute("compex_tag", TYPE_ATTRIBUTES(type)); tag != NULL_TREE;
+       tag = lookup_attribute("compex_tag", TREE_CHAIN(tag))) {
+    tree args = TREE_VALUE(tag);
+    if (args && TREE_CODE(TREE_VALUE(args)) == STRING_CST
+        && !strcmp(TREE_STRING_POINTER(TREE_VALUE(args)), name))
+      return args;
+  }
+  return NULL_TREE;
+}
+
+/* _tag_int_arg
+ * ------------
+ * Returns the integer following the name in a tag found by _find_tag, or dflt
+ * if there is none.
+ */
+static HOST_WIDE_INT
+_tag_int_arg(tree args, HOST_WIDE_INT dflt) {
+  tree next = TREE_CHAIN(args);
+  if (next && TREE_CODE(TREE_VALUE(next)) == INTEGER_CST && tree_fits_shwi_p(TREE_VALUE(next)))
+    return tree_to_shwi(TREE_VALUE(next));
+  return dflt;
+}
+
+/* _walk_layout
+ * ------------
+ * Returns the number of padding bits in a complete record type. If
+ * breakdown is set, a note is emitted for each field and each hole.
+ */
+static unsigned HOST_WIDE_INT
+_walk_layout(tree type, bool breakdown) {
+  unsigned HOST_WIDE_INT end = 0, covered = 0;
+  unsigned HOST_WIDE_INT size = tree_to_uhwi(TYPE_SIZE(type));
+
+  for (tree f = TYPE_FIELDS(type); f != NULL_TREE; f = TREE_CHAIN(f)) {
+    if (TREE_CODE(f) != FIELD_DECL || !DECL_SIZE(f) || !tree_fits_uhwi_p(DECL_SIZE(f)))
+      continue;
+
+    unsigned HOST_WIDE_INT pos = int_bit_position(f);
+    unsigned HOST_WIDE_INT fsize = tree_to_uhwi(DECL_SIZE(f));
+    location_t loc = DECL_SOURCE_LOCATION(f);
+
+    if (breakdown && pos > end)
+      inform(loc, "%wu bits of padding before this field", pos - end);
+
+    if (breakdown) {
+      if (DECL_FIELD_IS_BASE(f))
+        inform(loc, "base %qT: offset %wu, %wu bytes",
+          TREE_TYPE(f), pos / BITS_PER_UNIT, fsize / BITS_PER_UNIT);
+      else if (DECL_C_BIT_FIELD(f))
+        inform(loc, "%qD: bit offset %wu, %wu bits", f, pos, fsize);
+      else
+        inform(loc, "%qD: offset %wu, %wu bytes",
+          f, pos / BITS_PER_UNIT, fsize / BITS_PER_UNIT);
+    }
+
+    if (pos + fsize > end) {
+      covered += pos + fsize - (pos > end ? pos : end);
+      end = pos + fsize;
+    }
+  }
+
+  if (breakdown && size > end)
+    inform(DECL_SOURCE_LOCATION(TYPE_NAME(type)), "%wu bits of tail padding", size - end);
+
+  return size - covered;
+}
+
+/* _check_budgets
+ * --------------
+ * Enforce the max_size, max_padding and cacheline_aligned layout budgets
+ * declared by tags on a complete record type.
+ */
+static void
+_check_budgets(tree type) {
+  location_t loc = DECL_SOURCE_LOCATION(TYPE_NAME(type));
+  bool failed = false;
+  tree args;
+
+  if (!tree_fits_uhwi_p(TYPE_SIZE(type)))
+    return;
+
+  unsigned HOST_WIDE_INT size = tree_to_uhwi(TYPE_SIZE_UNIT(type));
+  unsigned HOST_WIDE_INT align = TYPE_ALIGN_UNIT(type);
+
+  if ((args = _find_tag(type, "max_size"))) {
+    HOST_WIDE_INT limit = _tag_int_arg(args, -1);
+    if (limit < 0) {
+      error_at(loc, "COMPEX: %<max_size%> tag requires a byte count");
+    } else if (size > (unsigned HOST_WIDE_INT)limit) {
+      error_at(loc, "COMPEX: %qT is %wu bytes, exceeding its max_size budget of %wd bytes",
+        type, size, limit);
+      failed = true;
+    }
+  }
+
+  if ((args = _find_tag(type, "max_padding"))) {
+    HOST_WIDE_INT limit = _tag_int_arg(args, -1);
+    unsigned HOST_WIDE_INT padding = _walk_layout(type, false) / BITS_PER_UNIT;
+    if (limit < 0) {
+      error_at(loc, "COMPEX: %<max_padding%> tag requires a byte count");
+    } else if (padding > (unsigned HOST_WIDE_INT)limit) {
+      error_at(loc, "COMPEX: %qT has %wu bytes of padding, exceeding its max_padding budget of %wd bytes",
+        type, padding, limit);
+      failed = true;
+    }
+  }
+
+  if ((args = _find_tag(type, "cacheline_aligned"))) {
+    HOST_WIDE_INT line = _tag_int_arg(args, 64);
+    if (align < (unsigned HOST_WIDE_INT)line) {
+      error_at(loc, "COMPEX: %qT has alignment %wu, but is tagged cacheline_aligned (%wd bytes)",
+        type, align, line);
+      failed = true;
+    }
+  }
+
+  if (failed)
+    _walk_layout(type, true);
+}
+
+/* _special_ctor
+ * -------------
+ * Returns the copy or move constructor of a class, declaring it if it is
+ * implicit and has not been needed yet, or NULL_TREE if there is none.
+ */
+static tree
+_special_ctor(tree type, bool move) {
+  if (move ? CLASSTYPE_LAZY_MOVE_CTOR(type) : CLASSTYPE_LAZY_COPY_CTOR(type))
+    return lazily_declare_fn(move ? sfk_move_constructor : sfk_copy_constructor, type);
+
+  for (tree fn = TYPE_METHODS(type); fn != NULL_TREE; fn = TREE_CHAIN(fn)) {
+    if (TREE_CODE(fn) != FUNCTION_DECL)
+      continue;
+    if (move ? DECL_MOVE_CONSTRUCTOR_P(fn) : DECL_COPY_CONSTRUCTOR_P(fn))
+      return fn;
+  }
+  return NULL_TREE;
+}
+
+/* _moving_ctor
+ * ------------
+ * Returns the constructor used to construct a class from an rvalue: its move
+ * constructor, or its copy constructor if the move constructor is missing or
+ * is defaulted but defined as deleted, which overload resolution ignores.
+ * Sets *is_copy accordingly.
+ */
+static tree
+_moving_ctor(tree type, bool *is_copy) {
+  tree fn = _special_ctor(type, true);
+  if (fn && DECL_DELETED_FN(fn) && (DECL_ARTIFICIAL(fn) || DECL_DEFAULTED_FN(fn)))
+    fn = NULL_TREE;
+  *is_copy = !fn;
+  return fn ? fn : _special_ctor(type, false);
+}
+
+/* _memberwise_p
+ * -------------
+ * Returns true if a copy or move constructor is implicit or defaulted on its
+ * first declaration, so that its cost is that of the fields and bases.
+ */
+static bool
+_memberwise_p(tree fn) {
+  return DECL_ARTIFICIAL(fn) || (DECL_DEFAULTED_FN(fn) && !user_provided_p(fn));
+}
+
+static bool
+_nothrow_fn_p(tree fn) {
+  maybe_instantiate_noexcept(fn);
+  return TYPE_NOTHROW_P(TREE_TYPE(fn));
+}
+
+/* _lint_copy_move
+ * ---------------
+ * Warn about copies hidden in the moves of a structure tagged ("hot").
+ */
+static void
+_lint_copy_move(tree type) {
+  tree args = _find_tag(type, "hot");
+  if (!args)
+    return;
+
+  bool contiguous = false;
+  for (tree a = TREE_CHAIN(args); a != NULL_TREE; a = TREE_CHAIN(a))
+    if (TREE_CODE(TREE_VALUE(a)) == STRING_CST && !strcmp(TREE_STRING_POINTER(TREE_VALUE(a)), "contiguous"))
+      contiguous = true;
+
+  location_t loc = DECL_SOURCE_LOCATION(TYPE_NAME(type));
+  bool is_copy;
+  tree mv = _moving_ctor(type, &is_copy);
+  tree cp = _special_ctor(type, false);
+  bool implicit_copy = cp && _memberwise_p(cp) && !DECL_DELETED_FN(cp);
+  bool memberwise_move = mv && !is_copy && _memberwise_p(mv) && !DECL_DELETED_FN(mv);
+
+  if (mv && !is_copy && DECL_DELETED_FN(mv)) {
+    warning_at(DECL_SOURCE_LOCATION(mv), 0, "COMPEX: hot type %qT has a deleted move constructor", type);
+  } else if (is_copy && TYPE_HAS_COMPLEX_COPY_CTOR(type)) {
+    warning_at(loc, 0, "COMPEX: hot type %qT has no move constructor, so moving it runs its "
+      "non-trivial copy constructor", type);
+    for (tree fn = TYPE_METHODS(type); fn != NULL_TREE; fn = TREE_CHAIN(fn)) {
+      if (TREE_CODE(fn) != FUNCTION_DECL || DECL_ARTIFICIAL(fn) || DECL_CLONED_FUNCTION_P(fn))
+        continue;
+      if (DECL_DESTRUCTOR_P(fn) || DECL_COPY_CONSTRUCTOR_P(fn)
+          || (DECL_ASSIGNMENT_OPERATOR_P(fn) && copy_fn_p(fn)))
+        inform(DECL_SOURCE_LOCATION(fn), "the implicit move constructor is suppressed by this declaration");
+    }
+  } else if (mv && !is_copy && !DECL_ARTIFICIAL(mv) && !_nothrow_fn_p(mv)) {
+    warning_at(DECL_SOURCE_LOCATION(mv), 0, "COMPEX: move constructor of hot type %qT is not "
+      "noexcept, so std::vector reallocation will copy instead", type);
+  }
+
+  // For an implicit or defaulted move or copy, the cost comes from the
+  // fields and bases, so name them.
+  for (tree f = TYPE_FIELDS(type); f != NULL_TREE; f = TREE_CHAIN(f)) {
+    if (TREE_CODE(f) != FIELD_DECL)
+      continue;
+
+    tree ft = strip_array_types(TREE_TYPE(f));
+    if (!CLASS_TYPE_P(ft) || !COMPLETE_TYPE_P(ft))
+      continue;
+
+    location_t floc = DECL_SOURCE_LOCATION(f);
+    bool f_is_copy;
+    tree fmv = _moving_ctor(ft, &f_is_copy);
+
+    if (memberwise_move) {
+      if (f_is_copy && TYPE_HAS_COMPLEX_COPY_CTOR(ft))
+        warning_at(floc, 0, "COMPEX: moving hot type %qT copies %qD, as %qT has no move constructor",
+          type, f, ft);
+      else if (fmv && !_nothrow_fn_p(fmv) && !_nothrow_fn_p(mv))
+        warning_at(floc, 0, "COMPEX: move constructor of hot type %qT is not noexcept because "
+          "that of %qD (%qT) is not; std::vector reallocation will copy", type, f, ft);
+    }
+
+    if (implicit_copy && (contiguous || is_copy) && TYPE_HAS_COMPLEX_COPY_CTOR(ft))
+      warning_at(floc, 0, "COMPEX: copying hot type %qT runs the non-trivial copy constructor of %qD (%qT)",
+        type, f, ft);
+  }
+
+  if (contiguous && TYPE_HAS_COMPLEX_COPY_CTOR(type) && cp && !implicit_copy)
+    warning_at(DECL_SOURCE_LOCATION(cp), 0, "COMPEX: contiguous hot type %qT has a user-provided "
+      "copy constructor", type);
+}
+
+/* _ap_symbol
+ * ----------
+ * Returns the name of the access profiling counter array for a structure,
+ * built from its mangled name and field count.
+ * Warning: uses static storage for returned string.
+ */
+static const char *
+_ap_symbol(tree type) {
+  static char name[MANGLE_STR_LEN];
+  unsigned nfields = 0;
+  for (tree f = TYPE_FIELDS(type); f != NULL_TREE; f = TREE_CHAIN(f))
+    if (TREE_CODE(f) == FIELD_DECL)
+      ++nfields;
+
+  // Strip the _ZTI of the typeinfo symbol to leave the mangled type.
+  const char *mangled = IDENTIFIER_POINTER(mangle_typeinfo_for_type(type)) + 4;
+  snprintf(name, sizeof(name), "__compex_ap_%s_%u", mangled, nfields);
+  for (char *p = name; *p; ++p)
+    if (!ISALNUM(*p))
+      *p = '_';
+  return name;
+}
+
 /* _finish_type
  * ------------
  * Output type information on nodes which have at least one compex::tag
@@ -176,6 +528,8 @@ _finish_type(void *event_data, void *data) {
     return;
   }
 
+  _check_budgets(type);
+
   tree decl = TYPE_NAME(type);
   const char *struct_name = IDENTIFIER_POINTER(DECL_NAME(decl));
   const char *field_name;
@@ -195,6 +549,9 @@ _finish_type(void *event_data, void *data) {
 
   _dump_tags(type, 1);
 
+  if (_profile && _find_tag(type, "access_profile") && !uses_template_parms(type))
+    OUTF("  $apSymbol: %s\n", _ap_symbol(type));
+
   tree biv = TYPE_BINFO(type);
   tree bi;
   size_t n = biv ? BINFO_N_BASE_BINFOS(biv) : 0;
@@ -237,6 +594,9 @@ _finish_type(void *event_data, void *data) {
         OUTF("  %s: !compex/field\n", field_name);
         if (fdeclname)
           OUTF("    name: %s\n", field_name);
+        OUTF("    type: ");
+        _out_quoted(type_as_string(TREE_TYPE(arg), TFF_PLAIN_IDENTIFIER));
+        OUTF("\n");
         OUTF("    size: %d\n", sizeof_v);
         OUTF("    align: %d\n", DECL_ALIGN(arg));
         OUTF("    offset: %u\n", offset_v);
@@ -299,8 +659,244 @@ _finish_type(void *event_data, void *data) {
       OUTF("    thunk: true\n");
     if (TYPE_NOTHROW_P(TREE_TYPE(arg)))
       OUTF("    nothrow: true\n");
+
+    // Parameter types, excluding this and any VTT parameter. Unlike the
+    // mangled name, these do not depend on the enclosing class.
+    OUTF("    args:\n");
+    for (tree p = FUNCTION_FIRST_USER_PARMTYPE(arg); p && p != void_list_node; p = TREE_CHAIN(p)) {
+      OUTF("      - !compex/param\n");
+      OUTF("        type: ");
+      _out_quoted(type_as_string(strip_typedefs(TREE_VALUE(p)), TFF_PLAIN_IDENTIFIER));
+      OUTF("\n");
+    }
     _dump_tags(TREE_TYPE(arg), 2);
   }
+
+  // The lint declares any lazy copy and move constructors, so it runs after
+  // the methods are output to keep the output independent of it.
+  if (_lint)
+    _lint_copy_move(type);
+}
+
+/* _dump_function
+ * --------------
+ * Output information on a tagged free function. Called both when a
+ * declaration is finished and when a definition is about to be genericized,
+ * since a definition without a prior declaration produces only the latter.
+ */
+static std::unordered_set<tree> _dumped_functions;
+
+static void
+_dump_function(tree decl) {
+  if (TREE_CODE(decl) != FUNCTION_DECL || DECL_FUNCTION_MEMBER_P(decl))
+    return;
+
+  if (!lookup_attribute("compex_tag", TYPE_ATTRIBUTES(TREE_TYPE(decl))))
+    return;
+
+  if (!_dumped_functions.insert(decl).second)
+    return;
+
+  const char *function_name = IDENTIFIER_POINTER(DECL_NAME(decl));
+  const char *mangled_name = IDENTIFIER_POINTER(DECL_ASSEMBLER_NAME(decl));
+  OUTF("%s: !compex/function\n", mangled_name);
+  OUTF("  $srcFile: %s\n", DECL_SOURCE_FILE(decl));
+  OUTF("  $srcLine: %u\n", DECL_SOURCE_LINE(decl));
+  OUTF("  name: %s\n", function_name);
+  OUTF("  qualname: ");
+  _out_quoted(lang_hooks.decl_printable_name(decl, 1));
+  OUTF("\n");
+  OUTF("  asm: %s\n", mangled_name);
+  if (!TREE_PUBLIC(decl))
+    OUTF("  internal: true\n");
+  if (DECL_DECLARED_INLINE_P(decl))
+    OUTF("  inline: true\n");
+  if (DECL_EXTERN_C_P(decl))
+    OUTF("  externc: true\n");
+  if (TYPE_NOTHROW_P(TREE_TYPE(decl)))
+    OUTF("  nothrow: true\n");
+  _dump_tags(TREE_TYPE(decl), 1);
+}
+
+static void
+_finish_decl(void *event_data, void *data) {
+  _dump_function((tree)event_data);
+}
+
+static void
+_pre_genericize(void *event_data, void *data) {
+  _dump_function((tree)event_data);
+}
+
+/* Access Profiling
+ * ----------------
+ * A GIMPLE pass run just after the CFG is built (before SSA, so plain
+ * temporaries can be used) which inserts a counter increment before every
+ * statement reading or writing a field of a structure tagged
+ * ("access_profile").
+ */
+static std::unordered_map<tree, tree> _ap_counter_vars;
+
+/* _ap_counters
+ * ------------
+ * Returns the extern TLS counter array for a profiled structure, declaring it
+ * on first use.
+ */
+static tree
+_ap_counters(tree type) {
+  auto it = _ap_counter_vars.find(type);
+  if (it != _ap_counter_vars.end())
+    return it->second;
+
+  unsigned nfields = 0;
+  for (tree f = TYPE_FIELDS(type); f != NULL_TREE; f = TREE_CHAIN(f))
+    if (TREE_CODE(f) == FIELD_DECL)
+      ++nfields;
+
+  tree name = get_identifier(_ap_symbol(type));
+  tree var = build_decl(UNKNOWN_LOCATION, VAR_DECL, name,
+    build_array_type_nelts(uint64_type_node, 2*nfields));
+  TREE_PUBLIC(var) = 1;
+  DECL_EXTERNAL(var) = 1;
+  DECL_ARTIFICIAL(var) = 1;
+  SET_DECL_ASSEMBLER_NAME(var, name);
+  set_decl_tls_model(var, decl_default_tls_model(var));
+
+  _ap_counter_vars[type] = var;
+  return var;
+}
+
+/* _ap_field_index
+ * ---------------
+ * Returns the position of a field among the FIELD_DECLs of its structure,
+ * which is also its position among the !compex/field records.
+ */
+static unsigned
+_ap_field_index(tree type, tree field) {
+  unsigned i = 0;
+  for (tree f = TYPE_FIELDS(type); f != NULL_TREE && f != field; f = TREE_CHAIN(f))
+    if (TREE_CODE(f) == FIELD_DECL)
+      ++i;
+  return i;
+}
+
+struct _ap_walk_data {
+  gimple_stmt_iterator *gsi;
+  bool write;
+};
+
+static tree
+_ap_walk(tree *tp, int *walk_subtrees, void *data) {
+  _ap_walk_data *wd = (_ap_walk_data*)data;
+
+  // Taking the address of a field is not an access.
+  if (TREE_CODE(*tp) == ADDR_EXPR) {
+    *walk_subtrees = 0;
+    return NULL_TREE;
+  }
+
+  if (TREE_CODE(*tp) != COMPONENT_REF)
+    return NULL_TREE;
+
+  tree field = TREE_OPERAND(*tp, 1);
+  tree type  = TYPE_MAIN_VARIANT(DECL_CONTEXT(field));
+  if (TREE_CODE(type) != RECORD_TYPE || !_find_tag(type, "access_profile"))
+    return NULL_TREE;
+
+  unsigned idx = 2*_ap_field_index(type, field) + (wd->write ? 1 : 0);
+  tree counter = build4(ARRAY_REF, uint64_type_node, _ap_counters(type),
+    build_int_cst(integer_type_node, idx), NULL_TREE, NULL_TREE);
+  tree tmp = create_tmp_var(uint64_type_node, "compex_ap");
+
+  gsi_insert_before(wd->gsi, gimple_build_assign(tmp, counter), GSI_SAME_STMT);
+  gsi_insert_before(wd->gsi, gimple_build_assign(tmp, PLUS_EXPR, tmp,
+    build_int_cst(uint64_type_node, 1)), GSI_SAME_STMT);
+  gsi_insert_before(wd->gsi, gimple_build_assign(unshare_expr(counter), tmp), GSI_SAME_STMT);
+  return NULL_TREE;
+}
+
+static const pass_data _ap_pass_data = {
+  GIMPLE_PASS,    // type
+  "compex_ap",    // name
+  OPTGROUP_NONE,  // optinfo_flags
+  TV_NONE,        // tv_id
+  PROP_cfg,       // properties_required
+  0,              // properties_provided
+  0,              // properties_destroyed
+  0,              // todo_flags_start
+  0,              // todo_flags_finish
+};
+
+struct _ap_pass :public gimple_opt_pass {
+  _ap_pass(gcc::context *ctx) :gimple_opt_pass(_ap_pass_data, ctx) {}
+
+  virtual unsigned int execute(function *fun) {
+    basic_block bb;
+    FOR_EACH_BB_FN(bb, fun) {
+      for (gimple_stmt_iterator gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+        auto stmt = gsi_stmt(gsi);
+        if (is_gimple_debug(stmt))
+          continue;
+
+        // Operand 0 of an assignment or call is its LHS.
+        bool has_lhs = is_gimple_assign(stmt) || is_gimple_call(stmt);
+        for (unsigned i=0; i < gimple_num_ops(stmt); ++i) {
+          _ap_walk_data wd = { &gsi, has_lhs && i == 0 };
+          tree *op = gimple_op_ptr(stmt, i);
+          if (*op)
+            walk_tree(op, _ap_walk, &wd, NULL);
+        }
+      }
+    }
+    return 0;
+  }
+};
+
+/* Shared Output
+ * -------------
+ * In append mode all output goes to a memory buffer which is written out as
+ * one checksummed frame when compilation finishes.
+ */
+#define FRAME_HDR_LEN 32
+
+static uint32_t
+_crc32(const unsigned char *p, size_t n) {
+  uint32_t c = 0xFFFFFFFF;
+  while (n--) {
+    c ^= *p++;
+    for (int k=0; k<8; ++k)
+      c = (c >> 1) ^ (0xEDB88320 & -(c & 1));
+  }
+  return ~c;
+}
+
+static void
+_finish(void *event_data, void *data) {
+  if (!_append)
+    return;
+
+  fclose(_output_f);
+  _output_f = NULL;
+
+  char *frame = (char*)xmalloc(FRAME_HDR_LEN + _frame_len + 1);
+  snprintf(frame, FRAME_HDR_LEN + 1, "%%compex-frame %08x %08x\n",
+    (unsigned)_frame_len, (unsigned)_crc32((const unsigned char*)_frame_buf, _frame_len));
+  memcpy(frame + FRAME_HDR_LEN, _frame_buf, _frame_len);
+
+  // A single write to an O_APPEND descriptor cannot be interleaved with the
+  // writes of other compilers. A short write leaves a truncated frame, which
+  // readers skip, so it is not retried.
+  int fd = open(_output_fn, O_WRONLY|O_APPEND|O_CREAT, 0666);
+  ssize_t n = -1;
+  if (fd >= 0) {
+    n = write(fd, frame, FRAME_HDR_LEN + _frame_len);
+    close(fd);
+  }
+  if (n != (ssize_t)(FRAME_HDR_LEN + _frame_len))
+    LOGF("Could not append output frame to %s\n", _output_fn);
+
+  free(frame);
+  free(_frame_buf);
 }
 
 /* Attribute Registration
@@ -345,25 +941,53 @@ plugin_init(plugin_name_args *info, plugin_gcc_version *ver) {
   for (int i=0; i < info->argc; ++i) {
     k = info->argv[i].key, v = info->argv[i].value;
     if (!strcmp(k, "o")) {
-      if (strcmp(v, "-")) {
-        _output_f = fopen(v, "w");
-        if (!_output_f) {
-          LOGF("Could not open output file: %s\n", v);
-          return 1;
-        }
-      }
+      if (strcmp(v, "-"))
+        _output_fn = v;
+    } else if (!strcmp(k, "append")) {
+      _append = true;
     } else if (!strcmp(k, "a")) {
       _dumpall = true;
+    } else if (!strcmp(k, "lint")) {
+      _lint = true;
+    } else if (!strcmp(k, "p")) {
+      _profile = true;
     } else {
       LOGF("Unknown argument: %s\n", k);
       return 1;
     }
   }
 
+  // Open output.
+  if (_append) {
+    if (!_output_fn) {
+      LOGF("append requires an output filename\n");
+      return 1;
+    }
+    _output_f = open_memstream(&_frame_buf, &_frame_len);
+  } else if (_output_fn) {
+    _output_f = fopen(_output_fn, "w");
+  }
+  if (!_output_f) {
+    LOGF("Could not open output file: %s\n", _output_fn);
+    return 1;
+  }
+
   // Setup callbacks.
   register_callback(info->base_name, PLUGIN_INFO, NULL, (void*)&_plugin_info);
   register_callback(info->base_name, PLUGIN_ATTRIBUTES, &_register_attributes, NULL);
   register_callback(info->base_name, PLUGIN_FINISH_TYPE, &_finish_type, NULL);
+  register_callback(info->base_name, PLUGIN_FINISH_DECL, &_finish_decl, NULL);
+  register_callback(info->base_name, PLUGIN_PRE_GENERICIZE, &_pre_genericize, NULL);
+  register_callback(info->base_name, PLUGIN_FINISH, &_finish, NULL);
+
+  if (_profile) {
+    static struct register_pass_info ap_pass_info;
+    ap_pass_info.pass = new _ap_pass(g);
+    ap_pass_info.reference_pass_name = "cfg";
+    ap_pass_info.ref_pass_instance_number = 1;
+    ap_pass_info.pos_op = PASS_POS_INSERT_AFTER;
+    register_callback(info->base_name, PLUGIN_PASS_MANAGER_SETUP, NULL, &ap_pass_info);
+  }
 
   return 0;
 }
@@ -0,0 +1,156 @@
+# compexmeta.py
+# -------------
+# Shared loading of compex YAML output for the compex-* tools.
+
+import re, sys, zlib
+import yaml
+
+class CompexObject(yaml.YAMLObject):
+  pass
+
+class CompexStruct(CompexObject):
+  yaml_tag = '!compex/struct'
+  _type = 'compex/struct'
+
+class CompexField(CompexObject):
+  yaml_tag = '!compex/field'
+  _type = 'compex/field'
+
+class CompexMethod(CompexObject):
+  yaml_tag = '!compex/method'
+  _type = 'compex/method'
+
+class CompexBase(CompexObject):
+  yaml_tag = '!compex/base'
+  _type = 'compex/base'
+
+class CompexFunction(CompexObject):
+  yaml_tag = '!compex/function'
+  _type = 'compex/function'
+
+class CompexParam(CompexObject):
+  yaml_tag = '!compex/param'
+  _type = 'compex/param'
+
+FRAME_MAGIC = '%compex-frame '
+FRAME_HDR_LEN = 32
+r_frame_hdr = re.compile(r'''^%compex-frame ([0-9a-f]{8}) ([0-9a-f]{8})\n$''')
+
+def read_frames(data):
+  '''Returns the payloads of the valid frames in a shared output file written
+  in append mode, given its contents as bytes. Frames which are truncated or
+  fail their checksum, such as those left by a compiler killed mid-write, are
+  skipped with a warning and reading resumes at the next frame header. Each
+  payload is only decoded once its checksum has passed.'''
+  payloads = []
+  pos = 0
+  while True:
+    start = data.find(FRAME_MAGIC.encode(), pos)
+    if start < 0:
+      break
+    m = r_frame_hdr.match(data[start:start+FRAME_HDR_LEN].decode('ascii', 'replace'))
+    if m:
+      n, crc = int(m.group(1), 16), int(m.group(2), 16)
+      payload = data[start+FRAME_HDR_LEN:start+FRAME_HDR_LEN+n]
+      if len(payload) == n and zlib.crc32(payload) & 0xFFFFFFFF == crc:
+        try:
+          payloads.append(payload.decode('utf-8'))
+          pos = start + FRAME_HDR_LEN + n
+          continue
+        except UnicodeDecodeError:
+          pass
+    sys.stderr.write('compex: skipping damaged frame at offset %u\n' % start)
+    pos = start + 1
+  return payloads
+
+def load(f):
+  '''Loads compex output from a file object opened in binary mode, returning
+  the top-level dict. Shared output files containing frames from several
+  translation units are merged as by load_all(). A file is treated as shared
+  if a frame header appears anywhere in it, so that one whose first frame is
+  damaged is still read frame by frame.'''
+  data = f.read()
+  if isinstance(data, str):
+    data = data.encode('utf-8')
+  if FRAME_MAGIC.encode() not in data:
+    return yaml.load(data, Loader=yaml.Loader) or {}
+  d = {}
+  for p in read_frames(data):
+    for k, v in (yaml.load(p, Loader=yaml.Loader) or {}).items():
+      d.setdefault(k, v)
+  return d
+
+def load_all(files):
+  '''Loads and merges the output of several translation units. Types seen in
+  more than one unit are kept once, from the first unit which defines them.'''
+  d = {}
+  for f in files:
+    for k, v in load(f).items():
+      d.setdefault(k, v)
+  return d
+
+def base_name(b):
+  '''Returns the name of the class named by a base record, for either plugin.'''
+  if 'name' in b.__dict__:
+    return b.name
+  t = str(b.__dict__.get('type', ''))
+  for p in ('struct ', 'class '):
+    if t.startswith(p):
+      t = t[len(p):]
+  return t
+
+def members(obj, cls):
+  '''Returns the members of a struct record of the given class, in order.'''
+  return [v for v in obj.__dict__.values() if isinstance(v, cls)]
+
+def structs(d):
+  return [(k, v) for k, v in d.items() if isinstance(v, CompexStruct)]
+
+def field_offset(f):
+  '''Returns the byte offset of a field record, for either plugin. GCC gives
+  a byte offset and a bit offset from it; clang gives a bit offset only.'''
+  d = f.__dict__
+  if 'boffset' in d:
+    return d['offset'] + d['boffset'] // 8
+  return d['offset'] // 8
+
+r_clang_tag_arg = re.compile(r'''\s*(?:"((?:[^"\\]|\\.)*)"|(-?[0-9]+))\s*(,|$)''')
+
+def _parseClangTag(v):
+  # clang has no plugin attributes, so COMPEX_TAG(...) arrives as the
+  # stringified argument list of an annotate attribute: compex_tag "a", 42
+  L = []
+  v = v[len('compex_tag'):]
+  while v.strip() != '':
+    m = r_clang_tag_arg.match(v)
+    if not m:
+      raise ValueError('cannot parse compex_tag annotation: %r' % v)
+    if m.group(1) is not None:
+      L.append(re.sub(r'\\(.)', r'\1', m.group(1)))
+    else:
+      L.append(int(m.group(2)))
+    v = v[m.end():]
+  return L
+
+def get_tags(obj):
+  '''Returns the tags of an object as a list of lists, for either plugin.'''
+  d = obj.__dict__
+  if d.get('tags'):
+    return d['tags']
+  tags = []
+  for a in d.get('attrs') or []:
+    v = str(a.get('value', ''))
+    if a.get('name') == 'annotate' and v.startswith('compex_tag'):
+      t = _parseClangTag(v)
+      if len(t) > 0:
+        tags.append(t)
+  return tags
+
+def find_tag(obj, name):
+  '''Returns the first tag list of an object whose first item is name.'''
+  for t in get_tags(obj):
+    if len(t) > 0 and t[0] == name:
+      return t
+  return None
+
+# © 2014 Hugo Landau <hlandau@devever.net>         MIT License